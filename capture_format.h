@@ -0,0 +1,27 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+//=========================== Capture Stream Format ===========================//
+// Shared by main.c (encoder) and tools/capdecode.c (decoder).
+// All multi-byte fields are little-endian.
+//
+//   stream : header { frame }*
+//   header : "WDC1" u16 width u16 height
+//   frame  : [ cost ] { span }* CAP_TAG_END
+//   cost   : CAP_TAG_COST u32 ticks
+//   span   : CAP_TAG_SPAN u16 y u16 x u16 length { run }*
+//   run    : u8 count (1..CAP_MAX_RUN) u16 color (RGB565)
+//
+// The runs of a span cover exactly `length` pixels of row `y` starting at
+// `x`. Pixels outside every span keep their value from the previous frame;
+// the frame before the first one is all black. `ticks` is how long the
+// encoder took on the frame, in 100 MHz interval-timer ticks.
+
+#define CAP_MAGIC "WDC1"
+#define CAP_HEADER_SIZE 8
+#define CAP_TAG_SPAN 0x01
+#define CAP_TAG_COST 0x02
+#define CAP_TAG_END 0xFF
+#define CAP_MAX_RUN 255
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+//=========================== Swept Collision ===========================//
+// Shared by main.c and tools/sweeptest.c.
+// The player moves along one axis per frame, so the volume a box reaching
+// `reach` pixels around its centre sweeps from (prev_x, prev_y) to (x, y)
+// is exactly the box spanning both ends. Testing that box instead of the
+// end position stops fast moves tunnelling through things, at the same
+// cost at any speed. Both boxes include their right and bottom edges.
+
+static inline int swept_hit(int prev_x, int prev_y, int x, int y, int reach,
+                            int left, int top, int right, int bottom) {
+ int sweep_left = (prev_x < x ? prev_x : x) - reach;
+ int sweep_right = (prev_x > x ? prev_x : x) + reach;
+ int sweep_top = (prev_y < y ? prev_y : y) - reach;
+ int sweep_bottom = (prev_y > y ? prev_y : y) + reach;
+ return sweep_right >= left && sweep_left <= right &&
+        sweep_bottom >= top && sweep_top <= bottom;
+}
+
+#endif
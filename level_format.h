@@ -0,0 +1,76 @@
+#ifndef LEVEL_FORMAT_H
+#define LEVEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=========================== Level File Format ===========================//
+// Shared by main.c (loader) and tools/levelgen.c, tools/levelbench.c.
+// Little-endian, with every field 4-byte aligned so a mapped file or a
+// linked-in blob is used in place:
+//
+//   LevelHeader
+//   uint32_t chunk_first[num_chunks + 1]  first record of each chunk
+//   LevelRecord records[num_records]      sorted by path position
+//
+// The player only moves up or right, so x - y never decreases along the
+// way; that is the path position. A record's position is the lowest one
+// over its box, x - (y + height), and chunk c holds the records positioned
+// in [path_origin + c * chunk_span, path_origin + (c + 1) * chunk_span).
+// Coordinates are absolute world coordinates, with the player starting at
+// (SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2).
+
+#define LEVEL_MAGIC 0x564C4457  // "WDLV"
+#define LEVEL_VERSION 1
+
+#define LEVEL_OBSTACLE 0
+#define LEVEL_COLLECTIBLE 1  // kind = LEVEL_COLLECTIBLE + collectible type
+
+typedef struct {
+ uint32_t magic;
+ uint16_t version;
+ uint16_t record_size;
+ int32_t path_origin;
+ int32_t chunk_span;
+ uint32_t num_records;
+ uint32_t num_chunks;
+} LevelHeader;
+
+typedef struct {
+ int32_t x, y;  // top-left corner
+ uint8_t width, height;
+ uint8_t kind;
+ uint8_t reserved;
+} LevelRecord;
+
+static inline int level_record_path(const LevelRecord *rec) {
+ return rec->x - (rec->y + rec->height);
+}
+
+static inline const uint32_t *level_chunk_index(const LevelHeader *level) {
+ return (const uint32_t *)(level + 1);
+}
+
+static inline const LevelRecord *level_records(const LevelHeader *level) {
+ return (const LevelRecord *)(level_chunk_index(level) + level->num_chunks + 1);
+}
+
+// returns 0 when the data is a level that is safe to use in place
+static inline int level_check(const void *data, size_t size) {
+ const LevelHeader *level = (const LevelHeader *)data;
+ if (!data || ((uintptr_t)data & 3) || size < sizeof(LevelHeader)) return -1;
+ if (level->magic != LEVEL_MAGIC || level->version != LEVEL_VERSION ||
+     level->record_size != sizeof(LevelRecord) || level->chunk_span <= 0)
+   return -1;
+ size_t avail = size - sizeof(LevelHeader);
+ if (level->num_chunks >= avail / sizeof(uint32_t)) return -1;
+ avail -= (level->num_chunks + 1) * sizeof(uint32_t);
+ if (level->num_records > avail / sizeof(LevelRecord)) return -1;
+ const uint32_t *first = level_chunk_index(level);
+ if (first[0] != 0 || first[level->num_chunks] != level->num_records) return -1;
+ for (uint32_t c = 0; c < level->num_chunks; c++)
+   if (first[c] > first[c + 1]) return -1;
+ return 0;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef LEVEL_STREAM_H
+#define LEVEL_STREAM_H
+
+#include "level_format.h"
+
+//=========================== Level Streaming ===========================//
+// Shared by main.c and tools/levelbench.c, so the benchmark times the code
+// the game runs, and by tools/levelgen.c to refuse levels the game can't
+// hold. A level is streamed in place: as the camera's path position comes
+// within LEVEL_LOOKAHEAD of a chunk, its records are handed out one by one,
+// except those the camera has already left behind.
+
+// the game's screen (main.c checks its SCREEN_WIDTH and SCREEN_HEIGHT), and
+// how far past its left and bottom edges an entity is kept
+#define LEVEL_VIEW_WIDTH 320
+#define LEVEL_VIEW_HEIGHT 240
+#define PRUNE_MARGIN 20
+// path distance ahead of the camera at which a chunk is streamed in
+#define LEVEL_LOOKAHEAD ((LEVEL_VIEW_WIDTH + LEVEL_VIEW_HEIGHT) / 2 + 40)
+// is_behind() has dropped every entity whose top-right corner is more than
+// this far behind the camera's path position
+#define LEVEL_BEHIND ((LEVEL_VIEW_WIDTH + LEVEL_VIEW_HEIGHT) / 2 + 2 * PRUNE_MARGIN)
+
+// The game keeps the streamed entities in fixed arrays of these sizes.
+#define LEVEL_MAX_OBSTACLES 200
+#define LEVEL_MAX_COLLECTIBLES 32
+
+typedef struct {
+ const LevelHeader *level;
+ const uint32_t *chunk_first;
+ const LevelRecord *records;
+ uint32_t next_chunk;   // chunks before this one have been entered
+ uint32_t next_record;  // next record of the entered chunks to hand out
+} LevelStream;
+
+// the camera only moves up or right, so anything whose right edge is left
+// of the screen, or whose top is below it (plus the margin), can never come
+// back into view. entities ahead are kept, which streaming relies on.
+static inline int is_behind(int x, int y, int width, int cam_x, int cam_y) {
+ return x + width < cam_x - (LEVEL_VIEW_WIDTH / 2 + PRUNE_MARGIN) ||
+        y > cam_y + (LEVEL_VIEW_HEIGHT / 2 + PRUNE_MARGIN);
+}
+
+// a collectible slot can take a new record when it is empty, or when what
+// it holds has fallen behind and is only waiting to be cleared
+static inline int level_slot_free(int active, int x, int y, int width, int cam_x,
+                                  int cam_y) {
+ return !active || is_behind(x, y, width, cam_x, cam_y);
+}
+
+// the most records of each kind that can be active at once, whatever route
+// the player takes. a record's path position lies in a window of the
+// camera's, from LEVEL_BEHIND plus its width and height behind to the end
+// of the chunk LEVEL_LOOKAHEAD ahead, so count the records in every such
+// window. the level must have passed level_check.
+static inline void level_peak_active(const LevelHeader *level, uint32_t *obstacles,
+                                     uint32_t *collectibles) {
+ const LevelRecord *records = level_records(level);
+ int max_extent = 0;
+ for (uint32_t i = 0; i < level->num_records; i++)
+   if (records[i].width + records[i].height > max_extent)
+     max_extent = records[i].width + records[i].height;
+ int window = LEVEL_BEHIND + max_extent + LEVEL_LOOKAHEAD + level->chunk_span;
+ uint32_t count[2] = {0, 0};
+ *obstacles = *collectibles = 0;
+ for (uint32_t first = 0, end = 0; first < level->num_records; first++) {
+   int limit = level_record_path(&records[first]) + window;
+   for (; end < level->num_records && level_record_path(&records[end]) < limit; end++)
+     count[records[end].kind != LEVEL_OBSTACLE]++;
+   if (count[0] > *obstacles) *obstacles = count[0];
+   if (count[1] > *collectibles) *collectibles = count[1];
+   count[records[first].kind != LEVEL_OBSTACLE]--;
+ }
+}
+
+static inline void level_stream_rewind(LevelStream *s) {
+ s->next_chunk = 0;
+ s->next_record = 0;
+}
+
+// returns 0 when the data is a valid level that never needs more active
+// entities than the game holds, and sets the stream up at its start
+static inline int level_stream_open(LevelStream *s, const void *data, size_t size) {
+ if (level_check(data, size) != 0) return -1;
+ uint32_t peak_obstacles, peak_collectibles;
+ level_peak_active((const LevelHeader *)data, &peak_obstacles, &peak_collectibles);
+ if (peak_obstacles > LEVEL_MAX_OBSTACLES || peak_collectibles > LEVEL_MAX_COLLECTIBLES)
+   return -1;
+ s->level = (const LevelHeader *)data;
+ s->chunk_first = level_chunk_index(s->level);
+ s->records = level_records(s->level);
+ level_stream_rewind(s);
+ return 0;
+}
+
+// the next record to add for a camera at (cam_x, cam_y), or 0 when there
+// are no more this frame. positions are relative to the world origin
+// (origin_x, origin_y), which wraps, so absolute ones are only subtracted.
+static inline const LevelRecord *level_stream_next(LevelStream *s, int cam_x, int cam_y,
+                                                   unsigned int origin_x,
+                                                   unsigned int origin_y) {
+ const LevelHeader *level = s->level;
+ while (1) {
+   if (s->next_record == s->chunk_first[s->next_chunk]) {
+     unsigned int camera_path = (cam_x + origin_x) - (cam_y + origin_y);
+     if (s->next_chunk == level->num_chunks ||
+         (int)(level->path_origin + s->next_chunk * level->chunk_span - camera_path) >
+             LEVEL_LOOKAHEAD)
+       return 0;
+     s->next_chunk++;
+     continue;
+   }
+   const LevelRecord *rec = &s->records[s->next_record++];
+   if (!is_behind((int)(rec->x - origin_x), (int)(rec->y - origin_y), rec->width,
+                  cam_x, cam_y))
+     return rec;
+ }
+}
+
+#endif
@@ -4,6 +4,15 @@
 #include <string.h>
 #include <time.h>
 
+#include "capture_format.h"
+#include "collision.h"
+#include "level_stream.h"
+
+#ifdef CAPTURE_PATH
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 //=========================== Hardware Address Macros ==========================//
 // Media Processing / Audio Interface
 #define AUDIO_BASE 0xFF203040
@@ -13,6 +22,8 @@
 #define TIMER_CONTROL (TIMER_BASE + 0x4)   // Control Register
 #define TIMER_START_LO (TIMER_BASE + 0x8)  // Start Count (Low 16-bits)
 #define TIMER_START_HI (TIMER_BASE + 0xC)  // Start Count (High 16-bits)
+#define TIMER_SNAP_LO (TIMER_BASE + 0x10)  // Counter Snapshot (Low 16-bits)
+#define TIMER_SNAP_HI (TIMER_BASE + 0x14)  // Counter Snapshot (High 16-bits)
 
 //------------------ Screen / Color Macros ------------------//
 #define SCREEN_WIDTH 320
@@ -31,6 +42,8 @@
 #define THRESHOLD 900000000 //for audio detection
 #define TIMER_0_5_SEC_HI 0x02FA
 #define TIMER_0_5_SEC_LO 0xF080
+#define TIMER_PERIOD ((TIMER_0_5_SEC_HI << 16) | TIMER_0_5_SEC_LO)
+#define FRAME_BUDGET (100000000 / 60)  // 100 MHz timer ticks per vsync
 
 
 #define HEX3_HEX0_BASE 0xFF200020
@@ -70,28 +83,33 @@ enum GameState game_state = RUNNING;
 int simple_mode = 0;
 
 //=========================== Obstacle Related ===========================//
+// positions are relative to the floating origin (see rebase_world), which
+// keeps them within 16 bits however long a session runs. colours aren't
+// stored: obstacles are always GREEN and a collectible's comes from its type
 typedef struct {
- int x, y;
- int width, height;
- short int color;
- int active;
+ short x, y;
+ uint8_t width, height;
+ uint8_t active;
 } Obstacle;
 
 typedef struct {
- int x, y;
- int width, height;
- short int color;
- int active;
- int type;  // 0: slow down, 1: get score, 2: boost and get three scores
+ short x, y;
+ uint8_t width, height;
+ uint8_t active;
+ uint8_t type;  // 0: slow down, 1: get score, 2: boost and get three scores
 } Collectible;
-Collectible collectible[3]; 
+const short int collectible_colors[3] = {BLUE, YELLOW, ORANGE};
+// slots 0-2 are the random spawner's, one per type; a level may use all
+#define MAX_COLLECTIBLES LEVEL_MAX_COLLECTIBLES
+Collectible collectible[MAX_COLLECTIBLES];
 
-#define MAX_OBSTACLES 200
+#define MAX_OBSTACLES LEVEL_MAX_OBSTACLES
 Obstacle obstacles[MAX_OBSTACLES];
 int num_obstacles = 0;
 int obstacle_spawn_counter = 0;
 int obstacle_spawn_interval = 30;
 void plot_pixel(int x, int y, short int color);
+void cmd_point(int x, int y, short int color);
 //=========================== Audio Interface Structure ===========================//
 typedef struct {
  volatile unsigned int control;
@@ -105,7 +123,7 @@ typedef struct {
 
 //=========================== Data Structures ===========================//
 typedef struct {
- int x, y;
+ short x, y;
  short int color;
 } Block;
 #define MAX_POINTS 100
@@ -121,9 +139,9 @@ short int get_random_color() {
 }
 //the particle displayed when the audio is detected and the block turns
 typedef struct {
- int x, y;    
- int vx, vy; 
- int life;  
+ short x, y;
+ int8_t vx, vy;
+ uint8_t life;
 } Particle;
 #define MAX_PARTICLES 50
 Particle particles[MAX_PARTICLES];
@@ -162,11 +180,60 @@ void draw_particles(int global_x, int global_y) {
    int screen_y = particles[i].y - global_y + (SCREEN_HEIGHT / 2);
    if (screen_x >= 0 && screen_x < SCREEN_WIDTH && screen_y >= 0 &&
        screen_y < SCREEN_HEIGHT)
-     plot_pixel(screen_x, screen_y, WHITE);
+     cmd_point(screen_x, screen_y, WHITE);
  }
 }
 
 
+//=========================== Floating Origin ===========================//
+// World coordinates are relative to an origin that follows the player, so
+// entities fit in 16 bits. Once the player is REBASE_DISTANCE away from the
+// screen-centre start position, everything is shifted back around it;
+// world_origin_x/y accumulate the shifts. They are unsigned and wrap on a
+// long enough run, so absolute positions are only ever compared by their
+// difference, which stays small.
+#define REBASE_DISTANCE 4096
+#define TRAIL_LIMIT 8192  // trail points beyond this are far off-screen
+unsigned int world_origin_x = 0;
+unsigned int world_origin_y = 0;
+
+short clamp_trail(int v) {
+ if (v < -TRAIL_LIMIT) return -TRAIL_LIMIT;
+ if (v > TRAIL_LIMIT) return TRAIL_LIMIT;
+ return v;
+}
+
+void rebase_world(int *global_x, int *global_y) {
+ int dx = *global_x - SCREEN_WIDTH / 2;
+ int dy = *global_y - SCREEN_HEIGHT / 2;
+ if (dx > -REBASE_DISTANCE && dx < REBASE_DISTANCE &&
+     dy > -REBASE_DISTANCE && dy < REBASE_DISTANCE)
+   return;
+ world_origin_x += dx;
+ world_origin_y += dy;
+ *global_x -= dx;
+ *global_y -= dy;
+ for (int i = 0; i < num_obstacles; i++) {
+   obstacles[i].x -= dx;
+   obstacles[i].y -= dy;
+ }
+ for (int i = 0; i < MAX_COLLECTIBLES; i++) {
+   collectible[i].x -= dx;
+   collectible[i].y -= dy;
+ }
+ for (int i = 0; i < num_particles; i++) {
+   particles[i].x -= dx;
+   particles[i].y -= dy;
+ }
+ // the trail is never pruned, so clamp its old points instead. the segments
+ // are axis-aligned and the limit is far outside the screen, so clamping
+ // keeps both their direction and their visible part unchanged.
+ for (int i = 0; i < num_points; i++) {
+   turning_points[i].x = clamp_trail(turning_points[i].x - dx);
+   turning_points[i].y = clamp_trail(turning_points[i].y - dy);
+ }
+}
+
 int key_released = 0;
 //detect the stop function according to key value
 int pause_key_prev = 0;
@@ -180,7 +247,8 @@ void swap(int *a, int *b);
 void spawn_obstacle(int global_x, int global_y);
 void prune_obstacles(int global_x, int global_y);
 void draw_obstacles(int global_x, int global_y);
-int check_collision(int global_x, int global_y);
+int check_collision(int prev_x, int prev_y, int global_x, int global_y);
+int check_pickup(int index, int prev_x, int prev_y, int global_x, int global_y);
 void reset_game(int *global_x, int *global_y, int *direction);
 void show_game_over();
 void display_time();
@@ -188,12 +256,26 @@ void update_background();
 void spawn_particles(int x, int y, int count);
 void update_particles();
 void draw_particles(int global_x, int global_y);
+void rebase_world(int *global_x, int *global_y);
 void display_score(int score);
 void spawn_collectible(int index, int global_x, int global_y);
 void draw_collectibles(int global_x, int global_y);
 void draw_pause_overlay(void);
 void draw_char(int x, int y, char c, short int color);
 void draw_string(int x, int y, const char *str, short int color);
+void render_begin();
+void render_rect(int x0, int y0, int x1, int y1);
+void render_frame(unsigned int camera_x, unsigned int camera_y, int trail_from);
+void scroll_invalidate();
+void scroll_mark(int x, int y, int width, int height, int global_x, int global_y);
+void scroll_note_dynamic(int first_cmd);
+void cmd_rect(int x, int y, int width, int height, short int color);
+void cmd_point(int x, int y, short int color);
+void governor_begin_frame();
+void governor_end_frame(int running);
+void capture_init();
+void capture_frame();
+void capture_drain();
 
 //=========================== Double Buffering ===========================//
 
@@ -215,6 +297,540 @@ void clear_all_buffers() {
  memset((void *)Buffer2, BLACK, total);
 }
 
+//=========================== Command Buffer Renderer ===========================//
+// While RUNNING, the trail, obstacles, particles, collectibles and player are
+// recorded as rectangles instead of being plotted one pixel at a time. Each
+// command is binned into the scanline bands it covers, and render_rect()
+// builds every band top to bottom in an on-chip tile before copying it out,
+// so each back buffer pixel is written exactly once, in row order.
+#define BAND_HEIGHT 16
+#define NUM_BANDS (SCREEN_HEIGHT / BAND_HEIGHT)
+#define MAX_DRAW_CMDS 512
+
+typedef struct {
+ short x0, y0, x1, y1;  // inclusive, clipped to the screen
+ short int color;
+} DrawCmd;
+DrawCmd draw_cmds[MAX_DRAW_CMDS];
+int num_draw_cmds = 0;
+short band_cmds[NUM_BANDS][MAX_DRAW_CMDS];  // command indices in draw order
+int band_count[NUM_BANDS];
+short int band_tile[BAND_HEIGHT][SCREEN_WIDTH];
+unsigned short frame_bg;  // bg_color as of render_begin()
+
+// called where clear_screen() used to run, so the frame keeps the background
+// it would have been cleared to even if a clap changes bg_color afterwards
+void render_begin() {
+ num_draw_cmds = 0;
+ for (int b = 0; b < NUM_BANDS; b++) band_count[b] = 0;
+ frame_bg = bg_color;
+}
+
+void cmd_rect(int x, int y, int width, int height, short int color) {
+ int x0 = (x < 0) ? 0 : x;
+ int y0 = (y < 0) ? 0 : y;
+ int x1 = (x + width > SCREEN_WIDTH) ? SCREEN_WIDTH - 1 : x + width - 1;
+ int y1 = (y + height > SCREEN_HEIGHT) ? SCREEN_HEIGHT - 1 : y + height - 1;
+ if (x0 > x1 || y0 > y1 || num_draw_cmds >= MAX_DRAW_CMDS) return;
+ DrawCmd *cmd = &draw_cmds[num_draw_cmds];
+ cmd->x0 = x0;
+ cmd->y0 = y0;
+ cmd->x1 = x1;
+ cmd->y1 = y1;
+ cmd->color = color;
+ for (int b = y0 / BAND_HEIGHT; b <= y1 / BAND_HEIGHT; b++)
+   band_cmds[b][band_count[b]++] = num_draw_cmds;
+ num_draw_cmds++;
+}
+
+void cmd_point(int x, int y, short int color) {
+ cmd_rect(x, y, 1, 1, color);
+}
+
+// clear_screen() fills byte-wise with memset, so the background is the low
+// byte of the colour repeated; match it so both paths draw identical frames
+short int background_fill() {
+ return (short int)((frame_bg & 0xFF) | ((frame_bg & 0xFF) << 8));
+}
+
+// rasterizes the background and recorded commands into the inclusive screen
+// rectangle (x0, y0)-(x1, y1), leaving the rest of the back buffer alone
+void render_rect(int x0, int y0, int x1, int y1) {
+ if (x0 < 0) x0 = 0;
+ if (y0 < 0) y0 = 0;
+ if (x1 >= SCREEN_WIDTH) x1 = SCREEN_WIDTH - 1;
+ if (y1 >= SCREEN_HEIGHT) y1 = SCREEN_HEIGHT - 1;
+ if (x0 > x1 || y0 > y1) return;
+ short int fill = background_fill();
+ for (int b = y0 / BAND_HEIGHT; b <= y1 / BAND_HEIGHT; b++) {
+   int band_top = b * BAND_HEIGHT;
+   int top = ((y0 > band_top) ? y0 : band_top) - band_top;
+   int bottom = ((y1 < band_top + BAND_HEIGHT) ? y1 : band_top + BAND_HEIGHT - 1) - band_top;
+   for (int row = top; row <= bottom; row++)
+     for (int x = x0; x <= x1; x++) band_tile[row][x] = fill;
+   for (int i = 0; i < band_count[b]; i++) {
+     DrawCmd *cmd = &draw_cmds[band_cmds[b][i]];
+     int cmd_top = (cmd->y0 - band_top > top) ? cmd->y0 - band_top : top;
+     int cmd_bottom = (cmd->y1 - band_top < bottom) ? cmd->y1 - band_top : bottom;
+     int left = (cmd->x0 > x0) ? cmd->x0 : x0;
+     int right = (cmd->x1 < x1) ? cmd->x1 : x1;
+     for (int row = cmd_top; row <= cmd_bottom; row++)
+       for (int x = left; x <= right; x++) band_tile[row][x] = cmd->color;
+   }
+   for (int row = top; row <= bottom; row++)
+     memcpy((void *)(pixel_buffer_start + ((band_top + row) << 10) + (x0 << 1)),
+            &band_tile[row][x0], (x1 - x0 + 1) * sizeof(short int));
+ }
+}
+
+//=========================== Scroll-Blit Renderer ===========================//
+// The camera moves a few pixels up or right per frame, so most of what a
+// buffer last showed is still right, just shifted. render_frame() moves the
+// buffer's old contents by the camera delta in one block move, then redraws
+// only what can differ: the strips scrolled into view, the player, the
+// trail's newest segment and particles (where they were and where they are),
+// and entities that appeared or vanished on screen. The back buffer was last
+// drawn two frames ago, so each buffer keeps its own history. Anything a
+// shift can't explain (a background change, the trail being shortened, pause
+// or game over) falls back to a full redraw. Build with -DSCROLL_BLIT=0 to
+// always redraw.
+#ifndef SCROLL_BLIT
+#define SCROLL_BLIT 1
+#endif
+#define MAX_DYNAMIC_RECTS (MAX_PARTICLES + 1)
+#define MAX_DIRTY_RECTS 16
+
+typedef struct {
+ int x0, y0, x1, y1;  // inclusive
+} Rect;
+
+typedef struct {
+ int valid;
+ unsigned int camera_x, camera_y;  // absolute world position of the screen centre
+ short int fill;
+ int trail_from;          // first turning point drawn
+ Rect dynamic[MAX_DYNAMIC_RECTS];  // trail head and particles, screen space
+ int num_dynamic;
+ Rect dirty[MAX_DIRTY_RECTS];      // changes since, in the same screen space
+ int num_dirty;
+ int dirty_overflow;
+} BufferHistory;
+BufferHistory buffer_history[2];
+Rect frame_dynamic[MAX_DYNAMIC_RECTS];
+int num_frame_dynamic = 0;
+
+void scroll_invalidate() {
+ buffer_history[0].valid = 0;
+ buffer_history[1].valid = 0;
+}
+
+// an entity appeared or vanished at (x, y). only changes on screen now are
+// kept: the rest of a buffer's old view is what its next shift discards,
+// and anything else comes in through a freshly drawn strip.
+void scroll_mark(int x, int y, int width, int height, int global_x, int global_y) {
+ int screen_x = x - global_x + (SCREEN_WIDTH / 2);
+ int screen_y = y - global_y + (SCREEN_HEIGHT / 2);
+ if (screen_x + width <= 0 || screen_x >= SCREEN_WIDTH ||
+     screen_y + height <= 0 || screen_y >= SCREEN_HEIGHT)
+   return;
+ for (int b = 0; b < 2; b++) {
+   BufferHistory *h = &buffer_history[b];
+   if (h->num_dirty == MAX_DIRTY_RECTS) {
+     h->dirty_overflow = 1;
+     continue;
+   }
+   // placed where the buffer's camera would have shown it
+   Rect *r = &h->dirty[h->num_dirty++];
+   r->x0 = (int)(x + world_origin_x - h->camera_x) + (SCREEN_WIDTH / 2);
+   r->y0 = (int)(y + world_origin_y - h->camera_y) + (SCREEN_HEIGHT / 2);
+   r->x1 = r->x0 + width - 1;
+   r->y1 = r->y0 + height - 1;
+ }
+}
+
+// remembers the commands recorded since first_cmd as this frame's dynamic
+// elements, so the buffer can erase them next time round
+void scroll_note_dynamic(int first_cmd) {
+ for (int i = first_cmd; i < num_draw_cmds && num_frame_dynamic < MAX_DYNAMIC_RECTS; i++) {
+   Rect *r = &frame_dynamic[num_frame_dynamic++];
+   r->x0 = draw_cmds[i].x0;
+   r->y0 = draw_cmds[i].y0;
+   r->x1 = draw_cmds[i].x1;
+   r->y1 = draw_cmds[i].y1;
+ }
+}
+
+// moves the back buffer's contents so that pixel (x, y) takes the value
+// that was at (x + dx, y + dy)
+void scroll_buffer(int dx, int dy) {
+ int width = (SCREEN_WIDTH - (dx < 0 ? -dx : dx)) * sizeof(short int);
+ int dst_x = (dx < 0) ? -dx : 0;
+ int src_x = (dx > 0) ? dx : 0;
+ if (dy >= 0) {
+   for (int y = 0; y < SCREEN_HEIGHT - dy; y++)
+     memmove((void *)(pixel_buffer_start + (y << 10) + (dst_x << 1)),
+             (void *)(pixel_buffer_start + ((y + dy) << 10) + (src_x << 1)), width);
+ } else {
+   for (int y = SCREEN_HEIGHT - 1; y >= -dy; y--)
+     memmove((void *)(pixel_buffer_start + (y << 10) + (dst_x << 1)),
+             (void *)(pixel_buffer_start + ((y + dy) << 10) + (src_x << 1)), width);
+ }
+}
+
+void render_frame(unsigned int camera_x, unsigned int camera_y, int trail_from) {
+ BufferHistory *h = &buffer_history[(pixel_buffer_start == (int)Buffer1) ? 0 : 1];
+ short int fill = background_fill();
+ int dx = (int)(camera_x - h->camera_x);
+ int dy = (int)(camera_y - h->camera_y);
+ int cx = SCREEN_WIDTH / 2;
+ int cy = SCREEN_HEIGHT / 2;
+ if (!SCROLL_BLIT || !h->valid || h->dirty_overflow || h->fill != fill ||
+     h->trail_from != trail_from || dx <= -SCREEN_WIDTH || dx >= SCREEN_WIDTH ||
+     dy <= -SCREEN_HEIGHT || dy >= SCREEN_HEIGHT) {
+   render_rect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+ } else {
+   scroll_buffer(dx, dy);
+   if (dx > 0) render_rect(SCREEN_WIDTH - dx, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+   if (dx < 0) render_rect(0, 0, -dx - 1, SCREEN_HEIGHT - 1);
+   if (dy > 0) render_rect(0, SCREEN_HEIGHT - dy, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+   if (dy < 0) render_rect(0, 0, SCREEN_WIDTH - 1, -dy - 1);
+   for (int i = 0; i < h->num_dynamic; i++) {
+     Rect *r = &h->dynamic[i];
+     render_rect(r->x0 - dx, r->y0 - dy, r->x1 - dx, r->y1 - dy);
+   }
+   for (int i = 0; i < num_frame_dynamic; i++) {
+     Rect *r = &frame_dynamic[i];
+     render_rect(r->x0, r->y0, r->x1, r->y1);
+   }
+   for (int i = 0; i < h->num_dirty; i++) {
+     Rect *r = &h->dirty[i];
+     render_rect(r->x0 - dx, r->y0 - dy, r->x1 - dx, r->y1 - dy);
+   }
+   // the player's old and new squares; the newest trail segment, and any
+   // turn made since, lies in the box spanning them
+   render_rect((dx > 0) ? cx - 1 - dx : cx - 1, (dy > 0) ? cy - 1 - dy : cy - 1,
+               (dx < 0) ? cx + 1 - dx : cx + 1, (dy < 0) ? cy + 1 - dy : cy + 1);
+ }
+ h->valid = 1;
+ h->camera_x = camera_x;
+ h->camera_y = camera_y;
+ h->fill = fill;
+ h->trail_from = trail_from;
+ memcpy(h->dynamic, frame_dynamic, num_frame_dynamic * sizeof(Rect));
+ h->num_dynamic = num_frame_dynamic;
+ num_frame_dynamic = 0;
+ h->num_dirty = 0;
+ h->dirty_overflow = 0;
+}
+
+//=========================== Frame Timing ===========================//
+// The interval timer is free-running between restarts, so its snapshot
+// registers give the time within a frame without touching the timer.
+int vsync_count = -1;  // timer count when the last buffer swap landed
+
+int read_timer_count() {
+ *(volatile int *)TIMER_SNAP_LO = 0;  // latch the counter
+ int hi = *(volatile int *)TIMER_SNAP_HI & 0xFFFF;
+ int lo = *(volatile int *)TIMER_SNAP_LO & 0xFFFF;
+ return (hi << 16) | lo;
+}
+
+int ticks_since(int count) {
+ // the timer counts down and reloads every half second
+ int elapsed = count - read_timer_count();
+ if (elapsed < 0) elapsed += TIMER_PERIOD;
+ return elapsed;
+}
+
+//=========================== Frame Capture ===========================//
+// Build with -DCAPTURE_PATH=\"wavedash.cap\" to record every displayed frame.
+// The path may also name a FIFO for live spectating; tools/capdecode turns
+// the stream back into PPM/Y4M. Without it none of this is compiled in.
+#ifdef CAPTURE_PATH
+#define CAPTURE_RING_SIZE (1 << 18)   // must be a power of two
+#define CAPTURE_DRAIN_CHUNK 2048      // most bytes written per vsync poll
+#define CAPTURE_DRAIN_GUARD (FRAME_BUDGET / 8)  // no writes this close to vsync
+#define CAPTURE_SPAN_GAP 3            // unchanged pixels allowed inside a span
+
+typedef struct {
+ int frames;      // frames queued
+ int dropped;     // frames that didn't fit in the ring
+ int last_ticks;  // timer ticks capture_frame() took last frame
+ int worst_ticks;
+} CaptureStats;
+// the per-frame cost also goes into the stream for capdecode to report
+volatile CaptureStats capture;
+
+int cap_fd = -1;
+uint8_t cap_ring[CAPTURE_RING_SIZE];
+unsigned int cap_head = 0;  // next byte to encode
+unsigned int cap_tail = 0;  // next byte to write out
+int cap_overflow = 0;
+short int cap_shadow[SCREEN_HEIGHT][SCREEN_WIDTH];  // what the decoder holds
+uint8_t cap_row_dirty[SCREEN_HEIGHT];
+
+void capture_put(uint8_t byte) {
+ if (cap_head - cap_tail >= CAPTURE_RING_SIZE - 1) {
+   cap_overflow = 1;
+   return;
+ }
+ cap_ring[cap_head & (CAPTURE_RING_SIZE - 1)] = byte;
+ cap_head++;
+}
+
+void capture_put16(int value) {
+ capture_put(value & 0xFF);
+ capture_put((value >> 8) & 0xFF);
+}
+
+// on the board open() and write() are semihosting calls: the debugger
+// halts the CPU and does them on the host. if the path is a FIFO there, the
+// open waits until a reader has it open, so start capdecode first.
+void capture_init() {
+ cap_fd = open(CAPTURE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+ if (cap_fd < 0) return;
+ for (int i = 0; i < 4; i++) capture_put(CAP_MAGIC[i]);
+ capture_put16(SCREEN_WIDTH);
+ capture_put16(SCREEN_HEIGHT);
+}
+
+// diff the finished back buffer against the last captured frame and queue
+// the changed row spans as RLE runs. a frame that does not fit in the ring
+// is dropped whole, so cap_shadow always matches what the decoder has.
+void capture_frame() {
+ if (cap_fd < 0) return;
+ int start = read_timer_count();
+ unsigned int frame_start = cap_head;
+ cap_overflow = 0;
+ capture_put(CAP_TAG_COST);  // filled in once the frame is done
+ capture_put16(0);
+ capture_put16(0);
+ for (int y = 0; y < SCREEN_HEIGHT; y++) {
+   short int *row = (short int *)(pixel_buffer_start + (y << 10));
+   short int *prev = cap_shadow[y];
+   cap_row_dirty[y] = 0;
+   if (memcmp(row, prev, SCREEN_WIDTH * sizeof(short int)) == 0) continue;
+   cap_row_dirty[y] = 1;
+   int x = 0;
+   while (x < SCREEN_WIDTH) {
+     if (row[x] == prev[x]) {
+       x++;
+       continue;
+     }
+     int end = x + 1;
+     for (int i = end; i < SCREEN_WIDTH && i <= end + CAPTURE_SPAN_GAP; i++)
+       if (row[i] != prev[i]) end = i + 1;
+     capture_put(CAP_TAG_SPAN);
+     capture_put16(y);
+     capture_put16(x);
+     capture_put16(end - x);
+     for (int i = x; i < end;) {
+       short int color = row[i];
+       int run = 1;
+       while (i + run < end && run < CAP_MAX_RUN && row[i + run] == color) run++;
+       capture_put(run);
+       capture_put16(color);
+       i += run;
+     }
+     x = end;
+   }
+ }
+ capture_put(CAP_TAG_END);
+ if (cap_overflow) {
+   cap_head = frame_start;
+   capture.dropped++;
+   return;
+ }
+ for (int y = 0; y < SCREEN_HEIGHT; y++) {
+   if (cap_row_dirty[y])
+     memcpy(cap_shadow[y], (short int *)(pixel_buffer_start + (y << 10)),
+            SCREEN_WIDTH * sizeof(short int));
+ }
+ // nothing is drained before the next vsync wait, so the reserved bytes
+ // are still in the ring
+ int ticks = ticks_since(start);
+ for (int i = 0; i < 4; i++)
+   cap_ring[(frame_start + 1 + i) & (CAPTURE_RING_SIZE - 1)] = ticks >> (8 * i);
+ capture.frames++;
+ capture.last_ticks = ticks;
+ if (ticks > capture.worst_ticks) capture.worst_ticks = ticks;
+}
+
+// write out a bounded slice of the queued stream. called while polling for
+// vsync, so the host I/O overlaps the wait instead of the frame. each write
+// halts the board until the host has taken it, so the slices are small and
+// none is started close to the next vsync. the host falling behind slows
+// the drain and eventually drops frames; a reader that stops reading
+// stalls the game.
+void capture_drain() {
+ if (cap_fd < 0 || cap_head == cap_tail) return;
+ if (vsync_count >= 0 &&
+     FRAME_BUDGET - ticks_since(vsync_count) % FRAME_BUDGET < CAPTURE_DRAIN_GUARD)
+   return;
+ unsigned int offset = cap_tail & (CAPTURE_RING_SIZE - 1);
+ unsigned int count = cap_head - cap_tail;
+ if (count > CAPTURE_DRAIN_CHUNK) count = CAPTURE_DRAIN_CHUNK;
+ if (count > CAPTURE_RING_SIZE - offset) count = CAPTURE_RING_SIZE - offset;
+ int written = write(cap_fd, cap_ring + offset, count);
+ if (written < 0) {
+   close(cap_fd);
+   cap_fd = -1;
+   return;
+ }
+ cap_tail += written;
+}
+#else
+void capture_init() {}
+void capture_frame() {}
+void capture_drain() {}
+#endif
+
+//=========================== Quality Governor ===========================//
+// Times each RUNNING frame's work (vsync to vsync, minus the wait) with the
+// interval timer's snapshot registers and sheds optional work in steps when
+// frames run close to the budget. Levels are cumulative. Stepping down needs
+// a few heavy frames in a row, stepping back up needs a long run of light
+// ones, and frames in between reset both counts, so the level doesn't flap.
+// Missed vsyncs are counted separately from the swap-to-swap time, which
+// also covers whatever runs during the wait.
+#define QUALITY_FULL 0
+#define QUALITY_FEW_PARTICLES 1
+#define QUALITY_SHORT_TRAIL 2
+#define QUALITY_NO_FLASH 3
+#define QUALITY_NO_HUD 4
+#define GOV_HIGH_WATER (FRAME_BUDGET * 9 / 10)
+#define GOV_LOW_WATER (FRAME_BUDGET * 6 / 10)
+#define GOV_DEGRADE_FRAMES 3
+#define GOV_RESTORE_FRAMES 120
+#define PARTICLES_REDUCED 3
+#define TRAIL_REDUCED_POINTS 16
+
+typedef struct {
+ int quality_level;
+ int frames;      // RUNNING frames measured
+ int missed;      // vsyncs missed while RUNNING
+ int overran;     // frames whose work alone overran FRAME_BUDGET
+ int near_missed; // frames over GOV_HIGH_WATER
+ int last_work;   // timer ticks of the last frame
+ int worst_work;
+} GovernorStats;
+// volatile so the counters can be watched from the debugger while running
+volatile GovernorStats governor;
+int gov_frame_start = -1;  // vsync_count of the swap the frame started at
+int gov_frame_measured = 0;
+int gov_heavy_frames = 0;
+int gov_light_frames = 0;
+
+void governor_begin_frame() {
+ // the last frame's buffer was due one refresh after its own start; each
+ // further refresh before it landed is a vsync missed
+ if (gov_frame_measured && gov_frame_start >= 0 && vsync_count >= 0) {
+   int interval = gov_frame_start - vsync_count;
+   if (interval < 0) interval += TIMER_PERIOD;
+   if (interval > FRAME_BUDGET + FRAME_BUDGET / 2)
+     governor.missed += (interval + FRAME_BUDGET / 2) / FRAME_BUDGET - 1;
+ }
+ gov_frame_measured = 0;
+ gov_frame_start = vsync_count;
+}
+
+void governor_end_frame(int running) {
+ if (gov_frame_start < 0 || !running) return;
+ int work = ticks_since(gov_frame_start);
+ gov_frame_measured = 1;
+ governor.frames++;
+ governor.last_work = work;
+ if (work > governor.worst_work) governor.worst_work = work;
+ if (work > FRAME_BUDGET) governor.overran++;
+
+ if (work > GOV_HIGH_WATER) {
+   governor.near_missed++;
+   gov_light_frames = 0;
+   if (++gov_heavy_frames >= GOV_DEGRADE_FRAMES) {
+     if (governor.quality_level < QUALITY_NO_HUD) governor.quality_level++;
+     gov_heavy_frames = 0;
+   }
+ } else if (work < GOV_LOW_WATER) {
+   gov_heavy_frames = 0;
+   if (++gov_light_frames >= GOV_RESTORE_FRAMES) {
+     if (governor.quality_level > QUALITY_FULL) governor.quality_level--;
+     gov_light_frames = 0;
+   }
+ } else {
+   gov_heavy_frames = 0;
+   gov_light_frames = 0;
+ }
+}
+
+//=========================== Level Streaming ===========================//
+// A level replaces the random spawner with a precomputed layout (see
+// level_format.h and tools/levelgen). It is linked into the board image as
+// level_blob and used in place, never copied. level_stream.h hands out the
+// records of each chunk the camera's path position reaches, so a frame
+// only touches the chunks it enters, however big the level is, and here
+// they are added to the active arrays. A level that could ever have more
+// entities active than the arrays hold is refused.
+
+// defined by a level source generated with levelgen -c; without one these
+// weak references stay null and the game spawns randomly
+extern const unsigned char level_blob[] __attribute__((weak));
+extern const unsigned int level_blob_size __attribute__((weak));
+
+_Static_assert(SCREEN_WIDTH == LEVEL_VIEW_WIDTH && SCREEN_HEIGHT == LEVEL_VIEW_HEIGHT,
+               "level_stream.h prunes and streams for this screen size");
+
+const LevelHeader *level = 0;
+LevelStream level_cursor;
+
+int level_attach(const void *data, size_t size) {
+ if (level_stream_open(&level_cursor, data, size) != 0) return -1;
+ level = level_cursor.level;
+ return 0;
+}
+
+// level_attach() made sure the arrays hold everything that is not behind
+// the camera. obstacles are pruned before streaming; a collectible that
+// has fallen behind is only cleared later in the frame (see
+// level_slot_free).
+void level_add(const LevelRecord *rec, int global_x, int global_y) {
+ int x = (int)(rec->x - world_origin_x);
+ int y = (int)(rec->y - world_origin_y);
+ if (rec->kind == LEVEL_OBSTACLE) {
+   if (num_obstacles >= MAX_OBSTACLES) return;
+   Obstacle *obs = &obstacles[num_obstacles++];
+   obs->x = x;
+   obs->y = y;
+   obs->width = rec->width;
+   obs->height = rec->height;
+   obs->active = 1;
+   scroll_mark(x, y, rec->width, rec->height, global_x, global_y);
+   return;
+ }
+ int type = rec->kind - LEVEL_COLLECTIBLE;
+ if (type < 0 || type > 2) return;
+ for (int i = 0; i < MAX_COLLECTIBLES; i++) {
+   if (!level_slot_free(collectible[i].active, collectible[i].x, collectible[i].y,
+                        collectible[i].width, global_x, global_y))
+     continue;
+   collectible[i].x = x;
+   collectible[i].y = y;
+   collectible[i].width = rec->width;
+   collectible[i].height = rec->height;
+   collectible[i].type = type;
+   collectible[i].active = 1;
+   scroll_mark(x, y, rec->width, rec->height, global_x, global_y);
+   return;
+ }
+}
+
+void level_stream(int global_x, int global_y) {
+ if (!level) return;
+ const LevelRecord *rec;
+ while ((rec = level_stream_next(&level_cursor, global_x, global_y, world_origin_x,
+                                 world_origin_y)))
+   level_add(rec, global_x, global_y);
+}
+
 //=========================== Obstacle & Collectible Functions ===========================//
 void spawn_obstacle(int global_x, int global_y) {
  if (num_obstacles >= MAX_OBSTACLES) return;
@@ -225,7 +841,6 @@ void spawn_obstacle(int global_x, int global_y) {
    Obstacle new_obs;
    new_obs.width = 10;
    new_obs.height = 10;
-   new_obs.color = GREEN;
    new_obs.active = 1;
    new_obs.x = global_x + offset_x;
    new_obs.y = global_y + offset_y;
@@ -244,7 +859,7 @@ void spawn_obstacle(int global_x, int global_y) {
    }
 
    if (!overlap) {
-     for (int i = 0; i < 3; i++) {
+     for (int i = 0; i < MAX_COLLECTIBLES; i++) {
        if (collectible[i].active) {
          int col_left = collectible[i].x;
          int col_right = collectible[i].x + collectible[i].width;
@@ -266,6 +881,8 @@ void spawn_obstacle(int global_x, int global_y) {
    if (!overlap) {
      obstacles[num_obstacles] = new_obs;
      num_obstacles++;
+     scroll_mark(new_obs.x, new_obs.y, new_obs.width, new_obs.height,
+                 global_x, global_y);
      break;
    }
    attempts++;
@@ -273,16 +890,12 @@ void spawn_obstacle(int global_x, int global_y) {
 }
 
 void prune_obstacles(int global_x, int global_y) {
- int margin = 20;
  int new_count = 0;
  for (int i = 0; i < num_obstacles; i++) {
-   if (obstacles[i].active) {
-     if (obstacles[i].x >= global_x - (SCREEN_WIDTH / 2 + margin) &&
-         obstacles[i].x <= global_x + (SCREEN_WIDTH / 2 + margin) &&
-         obstacles[i].y >= global_y - (SCREEN_HEIGHT / 2 + margin) &&
-         obstacles[i].y <= global_y + (SCREEN_HEIGHT / 2 + margin)) {
-       obstacles[new_count++] = obstacles[i];
-     }
+   if (obstacles[i].active &&
+       !is_behind(obstacles[i].x, obstacles[i].y, obstacles[i].width, global_x,
+                  global_y)) {
+     obstacles[new_count++] = obstacles[i];
    }
  }
  num_obstacles = new_count;
@@ -296,34 +909,33 @@ void draw_obstacles(int global_x, int global_y) {
      if (screen_x + obstacles[i].width < 0 || screen_x >= SCREEN_WIDTH ||
          screen_y + obstacles[i].height < 0 || screen_y >= SCREEN_HEIGHT)
        continue;
-     for (int y = 0; y < obstacles[i].height; y++) {
-       for (int x = 0; x < obstacles[i].width; x++) {
-         plot_pixel(screen_x + x, screen_y + y, obstacles[i].color);
-       }
-     }
+     cmd_rect(screen_x, screen_y, obstacles[i].width, obstacles[i].height, GREEN);
    }
  }
 }
 
-int check_collision(int global_x, int global_y) {
- int block_left = global_x - 1;
- int block_right = global_x + 1;
- int block_top = global_y - 1;
- int block_bottom = global_y + 1;
+// swept against the player's 3x3 block, so a fast move can't tunnel
+// through an obstacle (see collision.h)
+int check_collision(int prev_x, int prev_y, int global_x, int global_y) {
  for (int i = 0; i < num_obstacles; i++) {
-   if (obstacles[i].active) {
-     int obs_left = obstacles[i].x;
-     int obs_right = obstacles[i].x + obstacles[i].width;
-     int obs_top = obstacles[i].y;
-     int obs_bottom = obstacles[i].y + obstacles[i].height;
-     if (block_right >= obs_left && block_left <= obs_right &&
-         block_bottom >= obs_top && block_top <= obs_bottom)
-       return 1;
-   }
+   if (obstacles[i].active &&
+       swept_hit(prev_x, prev_y, global_x, global_y, 1, obstacles[i].x,
+                 obstacles[i].y, obstacles[i].x + obstacles[i].width,
+                 obstacles[i].y + obstacles[i].height))
+     return 1;
  }
  return 0;
 }
 
+// collectibles are picked up by the block's centre, so only the segment
+// the centre travels is swept
+int check_pickup(int index, int prev_x, int prev_y, int global_x, int global_y) {
+ return swept_hit(prev_x, prev_y, global_x, global_y, 0, collectible[index].x,
+                  collectible[index].y,
+                  collectible[index].x + collectible[index].width,
+                  collectible[index].y + collectible[index].height);
+}
+
 void spawn_collectible(int index, int global_x, int global_y) {
  int candidate_x, candidate_y;
  while (1) {
@@ -350,7 +962,7 @@ void spawn_collectible(int index, int global_x, int global_y) {
      }
    }
    if (!overlap) {
-     for (int i = 0; i < 3; i++) {
+     for (int i = 0; i < MAX_COLLECTIBLES; i++) {
        if (i != index && collectible[i].active) {
          int col2_left = collectible[i].x;
          int col2_right = collectible[i].x + collectible[i].width;
@@ -370,6 +982,10 @@ void spawn_collectible(int index, int global_x, int global_y) {
    }
    if (!overlap) break;
  }
+ if (collectible[index].active)
+   scroll_mark(collectible[index].x, collectible[index].y,
+               collectible[index].width, collectible[index].height,
+               global_x, global_y);
  collectible[index].x = candidate_x;
  collectible[index].y = candidate_y;
  collectible[index].width = 8;
@@ -377,29 +993,24 @@ void spawn_collectible(int index, int global_x, int global_y) {
  collectible[index].active = 1;
  if (index == 0) {
    collectible[index].type = 0;  // blue, slow down
-   collectible[index].color = BLUE;
  } else if (index == 1) {
    collectible[index].type = 1;  // yellow, score++
-   collectible[index].color = YELLOW;
  } else if (index == 2) {
    collectible[index].type = 2;  // orange, score+3, speed up
-   collectible[index].color = ORANGE;
  }
+ scroll_mark(candidate_x, candidate_y, 8, 8, global_x, global_y);
 }
 
 void draw_collectibles(int global_x, int global_y) {
- for (int i = 0; i < 3; i++) {
+ for (int i = 0; i < MAX_COLLECTIBLES; i++) {
    if (!collectible[i].active) continue;
    int screen_x = collectible[i].x - global_x + (SCREEN_WIDTH / 2);
    int screen_y = collectible[i].y - global_y + (SCREEN_HEIGHT / 2);
    if (screen_x + collectible[i].width < 0 || screen_x >= SCREEN_WIDTH ||
        screen_y + collectible[i].height < 0 || screen_y >= SCREEN_HEIGHT)
      continue;
-   for (int y = 0; y < collectible[i].height; y++) {
-     for (int x = 0; x < collectible[i].width; x++) {
-       plot_pixel(screen_x + x, screen_y + y, collectible[i].color);
-     }
-   }
+   cmd_rect(screen_x, screen_y, collectible[i].width, collectible[i].height,
+            collectible_colors[collectible[i].type]);
  }
 }
 
@@ -408,11 +1019,15 @@ void reset_game(int *global_x, int *global_y, int *direction) {
  *global_x = SCREEN_WIDTH / 2;
  *global_y = SCREEN_HEIGHT / 2;
  *direction = 0;
+ world_origin_x = 0;
+ world_origin_y = 0;
  num_points = 1;
  turning_points[0].x = *global_x;
  turning_points[0].y = *global_y;
  turning_points[0].color = WHITE;
  num_obstacles = 0;
+ for (int i = 0; i < MAX_COLLECTIBLES; i++) collectible[i].active = 0;
+ level_stream_rewind(&level_cursor);
  obstacle_spawn_counter = 0;
  time_hundredths = 0;
  rounds = 0;
@@ -423,6 +1038,8 @@ void reset_game(int *global_x, int *global_y, int *direction) {
  *(volatile int *)TIMER_START_HI = TIMER_0_5_SEC_HI;
  *(volatile int *)TIMER_START_LO = TIMER_0_5_SEC_LO;
  *(volatile int *)TIMER_CONTROL = 0x7;
+ vsync_count = -1;  // the restart above invalidates this frame's timing
+ gov_frame_start = -1;
 
  clear_all_buffers();
 
@@ -445,6 +1062,7 @@ void display_time() {
         rounds++;
         *LED_REG = (1 << (rounds - 1));
     }
+    if (governor.quality_level >= QUALITY_NO_HUD) return;
     int int_part = time_hundredths / 100;
     int frac_part = time_hundredths % 100;
     int d3 = int_part / 10;
@@ -472,17 +1090,18 @@ void plot_pixel(int x, int y, short int color) {
 void draw_line(int x0, int y0, int x1, int y1, short int color) {
  if (x0 == x1) {
    if (y1 < y0) swap(&y0, &y1);
-   for (int i = 0; i <= (y1 - y0); i++) plot_pixel(x0, y0 + i, color);
+   cmd_rect(x0, y0, 1, y1 - y0 + 1, color);
  } else {
    if (x1 < x0) swap(&x0, &x1);
-   for (int i = 0; i <= (x1 - x0); i++) plot_pixel(x0 + i, y0, color);
+   cmd_rect(x0, y0, x1 - x0 + 1, 1, color);
  }
 }
 
 void wait_for_vsync() {
  volatile int *pixel_ctrl_ptr = (int *)0xFF203020;
  *pixel_ctrl_ptr = 1;
- while ((*(pixel_ctrl_ptr + 3) & 1));
+ while ((*(pixel_ctrl_ptr + 3) & 1)) capture_drain();
+ vsync_count = read_timer_count();
 }
 
 void swap(int *a, int *b) {
@@ -622,17 +1241,25 @@ int main(void) {
  *(pixel_ctrl_ptr + 1) = (int)&Buffer2;
  pixel_buffer_start = *(pixel_ctrl_ptr + 1);
  clear_screen();
+ capture_init();
 
 
  *(volatile int *)TIMER_START_HI = TIMER_0_5_SEC_HI;
  *(volatile int *)TIMER_START_LO = TIMER_0_5_SEC_LO;
  *(volatile int *)TIMER_CONTROL = 0x7;
- for (int i = 0; i < 3; i++) {
-   spawn_collectible(i, global_x, global_y);
+ if (level_blob && &level_blob_size)
+   level_attach(level_blob, level_blob_size);
+ if (!level) {
+   for (int i = 0; i < 3; i++) {
+     spawn_collectible(i, global_x, global_y);
+   }
  }
 
  while (1) {
+   capture_frame();
+   governor_end_frame(game_state == RUNNING);
    wait_for_vsync();
+   governor_begin_frame();
    int front_buf = *pixel_ctrl_ptr;
    if (front_buf == (int)Buffer1) {
      *(pixel_ctrl_ptr + 1) = (int)&Buffer2;
@@ -642,7 +1269,7 @@ int main(void) {
      pixel_buffer_start = (int)Buffer1;
    }
    update_background();
-   clear_screen();
+   render_begin();
 
  
    volatile int *key_ptr = (int *)0xFF200050;
@@ -655,6 +1282,8 @@ int main(void) {
    pause_key_prev = current_pause;
 
    if (game_state == PAUSED) {
+     scroll_invalidate();
+     clear_screen();
      draw_pause_overlay();
      continue; 
    }
@@ -690,9 +1319,13 @@ int main(void) {
            direction = (direction == 0) ? 1 : 0;
            frameCount = 5;
            // randomly choose color
-           bg_color = get_random_color();
-           bg_timer = 10;
-           spawn_particles(global_x, global_y, 10);
+           if (governor.quality_level < QUALITY_NO_FLASH) {
+             bg_color = get_random_color();
+             bg_timer = 10;
+           }
+           spawn_particles(global_x, global_y,
+                           governor.quality_level >= QUALITY_FEW_PARTICLES
+                               ? PARTICLES_REDUCED : 10);
          }
        }
      } else {
@@ -706,24 +1339,29 @@ int main(void) {
      }
 
      //movement update
+     rebase_world(&global_x, &global_y);
+     int prev_x = global_x;
+     int prev_y = global_y;
      if (direction == 0)
        global_y -= speed_factor;
      else
        global_x += speed_factor;
 
-     obstacle_spawn_counter++;
-     if (obstacle_spawn_counter >= obstacle_spawn_interval) {
-       spawn_obstacle(global_x, global_y);
-       obstacle_spawn_counter = 0;
-     }
      prune_obstacles(global_x, global_y);
-     if (check_collision(global_x, global_y)) game_state = GAME_OVER;
-     for (int i = 0; i < 3; i++) {
+     if (level) {
+       level_stream(global_x, global_y);
+     } else {
+       obstacle_spawn_counter++;
+       if (obstacle_spawn_counter >= obstacle_spawn_interval) {
+         spawn_obstacle(global_x, global_y);
+         obstacle_spawn_counter = 0;
+       }
+     }
+     if (check_collision(prev_x, prev_y, global_x, global_y))
+       game_state = GAME_OVER;
+     for (int i = 0; i < MAX_COLLECTIBLES; i++) {
        if (collectible[i].active) {
-         if (global_x >= collectible[i].x &&
-             global_x <= collectible[i].x + collectible[i].width &&
-             global_y >= collectible[i].y &&
-             global_y <= collectible[i].y + collectible[i].height) {
+         if (check_pickup(i, prev_x, prev_y, global_x, global_y)) {
            if (collectible[i].type == 0) {
              speed_factor = 1;
              obstacle_spawn_interval = (simple_mode ? 60 : 30);
@@ -735,8 +1373,18 @@ int main(void) {
              if (score < 99) score += 4;
            }
            display_score(score);
+           scroll_mark(collectible[i].x, collectible[i].y, collectible[i].width,
+                       collectible[i].height, global_x, global_y);
            collectible[i].active = 0;
-           spawn_collectible(i, global_x, global_y);
+           if (!level) spawn_collectible(i, global_x, global_y);
+           continue;
+         }
+         if (level) {
+           // level collectibles may sit ahead, off-screen, until reached
+           if (is_behind(collectible[i].x, collectible[i].y, collectible[i].width,
+                         global_x, global_y))
+             collectible[i].active = 0;
+           continue;
          }
          int screen_x = collectible[i].x - global_x + (SCREEN_WIDTH / 2);
          int screen_y = collectible[i].y - global_y + (SCREEN_HEIGHT / 2);
@@ -750,9 +1398,13 @@ int main(void) {
      }
 
      //display route behind
-     int prev_disp_x = turning_points[0].x - global_x + (SCREEN_WIDTH / 2);
-     int prev_disp_y = turning_points[0].y - global_y + (SCREEN_HEIGHT / 2);
-     for (int i = 1; i < num_points; i++) {
+     int first_point = 0;
+     if (governor.quality_level >= QUALITY_SHORT_TRAIL &&
+         num_points > TRAIL_REDUCED_POINTS)
+       first_point = num_points - TRAIL_REDUCED_POINTS;
+     int prev_disp_x = turning_points[first_point].x - global_x + (SCREEN_WIDTH / 2);
+     int prev_disp_y = turning_points[first_point].y - global_y + (SCREEN_HEIGHT / 2);
+     for (int i = first_point + 1; i < num_points; i++) {
        int curr_disp_x = turning_points[i].x - global_x + (SCREEN_WIDTH / 2);
        int curr_disp_y = turning_points[i].y - global_y + (SCREEN_HEIGHT / 2);
        draw_line(prev_disp_x, prev_disp_y, curr_disp_x, curr_disp_y, WHITE);
@@ -761,19 +1413,23 @@ int main(void) {
      }
      int current_disp_x = SCREEN_WIDTH / 2;
      int current_disp_y = SCREEN_HEIGHT / 2;
+     int head_cmd = num_draw_cmds;
      draw_line(prev_disp_x, prev_disp_y, current_disp_x, current_disp_y, WHITE);
+     scroll_note_dynamic(head_cmd);
 
      draw_obstacles(global_x, global_y);
+     int first_particle_cmd = num_draw_cmds;
      draw_particles(global_x, global_y);
+     scroll_note_dynamic(first_particle_cmd);
      draw_collectibles(global_x, global_y);
 
 
-     for (int i = -1; i < 2; i++) {
-       for (int j = -1; j < 2; j++) {
-         plot_pixel(current_disp_x + i, current_disp_y + j, RED);
-       }
-     }
+     cmd_rect(current_disp_x - 1, current_disp_y - 1, 3, 3, RED);
+     render_frame(global_x + world_origin_x, global_y + world_origin_y,
+                  first_point);
    } else { // GAME_OVER 
+     scroll_invalidate();
+     clear_screen();
      show_game_over();
      if (!key_released) {
        if (((*key_ptr) & 0x1) != 0) key_released = 1;
@@ -794,8 +1450,10 @@ int main(void) {
            simple_mode = 0;
          obstacle_spawn_interval = (simple_mode ? 60 : 30);
          speed_factor = 1;
-         for (int i = 0; i < 3; i++) {
-           spawn_collectible(i, global_x, global_y);
+         if (!level) {
+           for (int i = 0; i < 3; i++) {
+             spawn_collectible(i, global_x, global_y);
+           }
          }
        }
      }
@@ -0,0 +1,179 @@
+// Host-side decoder for Wave Dash capture streams (see capture_format.h).
+//
+//   cc -O2 -I.. -o capdecode capdecode.c
+//   ./capdecode wavedash.cap game.y4m     # one Y4M video
+//   ./capdecode wavedash.cap frame        # frame_00000.ppm, frame_00001.ppm...
+//   ./capdecode live.fifo - | ffplay -    # live spectating
+//
+// An input of "-" reads stdin; an output of "-" writes Y4M to stdout.
+// Compression stats and the encoder's time per frame are printed to stderr
+// when the stream ends.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../capture_format.h"
+
+#define FPS 60
+#define TIMER_HZ 100000000
+
+int width, height;
+uint16_t *frame;
+uint8_t *rgb;
+long stream_bytes = 0;
+long cost_frames = 0;
+double cost_total = 0;
+long cost_worst = 0;
+
+int read_byte(FILE *in) {
+ int c = fgetc(in);
+ if (c != EOF) stream_bytes++;
+ return c;
+}
+
+int read16(FILE *in) {
+ int lo = read_byte(in);
+ int hi = read_byte(in);
+ if (lo == EOF || hi == EOF) return -1;
+ return lo | (hi << 8);
+}
+
+// returns 1 for a decoded frame, 0 at a clean end of stream, -1 on error
+int decode_frame(FILE *in) {
+ int tag = read_byte(in);
+ if (tag == EOF) return 0;
+ if (tag == CAP_TAG_COST) {
+   int lo = read16(in);
+   int hi = read16(in);
+   if (lo < 0 || hi < 0) return -1;
+   long ticks = lo | ((long)hi << 16);
+   cost_frames++;
+   cost_total += ticks;
+   if (ticks > cost_worst) cost_worst = ticks;
+   tag = read_byte(in);
+ }
+ while (tag == CAP_TAG_SPAN) {
+   int y = read16(in);
+   int x = read16(in);
+   int length = read16(in);
+   if (length < 0 || y < 0 || y >= height || x < 0 || x + length > width)
+     return -1;
+   uint16_t *dst = frame + y * width + x;
+   while (length > 0) {
+     int run = read_byte(in);
+     int color = read16(in);
+     if (run == EOF || run == 0 || run > length || color < 0) return -1;
+     for (int i = 0; i < run; i++) *dst++ = (uint16_t)color;
+     length -= run;
+   }
+   tag = read_byte(in);
+ }
+ return tag == CAP_TAG_END ? 1 : -1;
+}
+
+void to_rgb() {
+ for (int i = 0; i < width * height; i++) {
+   uint16_t p = frame[i];
+   int r = (p >> 11) & 0x1F;
+   int g = (p >> 5) & 0x3F;
+   int b = p & 0x1F;
+   rgb[i * 3] = (r << 3) | (r >> 2);
+   rgb[i * 3 + 1] = (g << 2) | (g >> 4);
+   rgb[i * 3 + 2] = (b << 3) | (b >> 2);
+ }
+}
+
+int write_ppm(const char *prefix, int index) {
+ char path[512];
+ snprintf(path, sizeof(path), "%s_%05d.ppm", prefix, index);
+ FILE *out = fopen(path, "wb");
+ if (!out) return -1;
+ fprintf(out, "P6\n%d %d\n255\n", width, height);
+ fwrite(rgb, 3, width * height, out);
+ fclose(out);
+ return 0;
+}
+
+// 4:4:4 BT.601 studio range, so no chroma subsampling smears the 1px trail
+void write_y4m_frame(FILE *out) {
+ int n = width * height;
+ static uint8_t *planes = 0;
+ if (!planes) planes = malloc(n * 3);
+ for (int i = 0; i < n; i++) {
+   int r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+   planes[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+   planes[n + i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+   planes[2 * n + i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+ }
+ fputs("FRAME\n", out);
+ fwrite(planes, 1, n * 3, out);
+ fflush(out);
+}
+
+int main(int argc, char **argv) {
+ if (argc != 3) {
+   fprintf(stderr, "usage: %s <capture|-> <out.y4m|ppm-prefix>\n", argv[0]);
+   return 2;
+ }
+ FILE *in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+ if (!in) {
+   perror(argv[1]);
+   return 1;
+ }
+ char magic[4];
+ for (int i = 0; i < 4; i++) magic[i] = read_byte(in);
+ width = read16(in);
+ height = read16(in);
+ if (memcmp(magic, CAP_MAGIC, 4) != 0 || width <= 0 || height <= 0) {
+   fprintf(stderr, "%s: not a Wave Dash capture\n", argv[1]);
+   return 1;
+ }
+ frame = calloc(width * height, sizeof(uint16_t));
+ rgb = malloc(width * height * 3);
+
+ const char *target = argv[2];
+ size_t len = strlen(target);
+ FILE *y4m = 0;
+ int to_stdout = strcmp(target, "-") == 0;
+ if (to_stdout || (len > 4 && strcmp(target + len - 4, ".y4m") == 0)) {
+   y4m = to_stdout ? stdout : fopen(target, "wb");
+   if (!y4m) {
+     perror(target);
+     return 1;
+   }
+   fprintf(y4m, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, FPS);
+ }
+
+ int frames = 0;
+ int status;
+ while ((status = decode_frame(in)) == 1) {
+   to_rgb();
+   if (y4m)
+     write_y4m_frame(y4m);
+   else if (write_ppm(target, frames) != 0) {
+     perror(target);
+     return 1;
+   }
+   frames++;
+ }
+ if (status < 0) fprintf(stderr, "truncated or corrupt frame %d\n", frames);
+ if (y4m && y4m != stdout) fclose(y4m);
+
+ long raw = (long)frames * width * height * 2;
+ fprintf(stderr, "%d frames, %ld stream bytes, %ld raw bytes", frames,
+         stream_bytes, raw);
+ if (stream_bytes > 0)
+   fprintf(stderr, ", ratio %.1f:1, %.0f bytes/frame", (double)raw / stream_bytes,
+           frames ? (double)stream_bytes / frames : 0.0);
+ fputc('\n', stderr);
+ if (cost_frames > 0) {
+   double budget = (double)TIMER_HZ / FPS;
+   fprintf(stderr, "encode time per frame: avg %.0f us (%.1f%% of a frame), "
+           "max %.0f us (%.1f%%)\n",
+           cost_total / cost_frames * 1e6 / TIMER_HZ,
+           100.0 * cost_total / cost_frames / budget,
+           cost_worst * 1e6 / TIMER_HZ, 100.0 * cost_worst / budget);
+ }
+ return status < 0;
+}
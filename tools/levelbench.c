@@ -0,0 +1,184 @@
+// Loader benchmark for Wave Dash levels: maps a level with mmap, flies the
+// camera along levelgen's route and times the per-frame streaming work
+// (chunk lookup, adding records, pruning the active set) with the game's
+// own code from level_stream.h. Obstacles and collectibles go into separate
+// pools of the game's sizes, and any record that doesn't fit is reported as
+// dropped; levels denser than that are refused up front. The player flies
+// the route too, and any step where it touches an obstacle is counted; for a
+// level from levelgen -n with the same seed there should be none.
+//
+//   cc -O2 -o levelbench levelbench.c
+//   ./levelgen -n 100000 big.bin && ./levelbench big.bin
+//   ./levelgen -n 1000000 huge.bin && ./levelbench huge.bin
+//
+// The per-frame numbers should not grow with the level size.
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../collision.h"
+#include "../level_stream.h"
+#include "levelpath.h"
+
+typedef struct {
+ int x, y;
+ int width, height;
+ int active;
+} Active;
+Active obstacles[LEVEL_MAX_OBSTACLES];  // packed, like main.c's
+int num_obstacles = 0;
+Active collectibles[LEVEL_MAX_COLLECTIBLES];  // slots, like main.c's
+long dropped_obstacles = 0, dropped_collectibles = 0;
+
+long now_ns() {
+ struct timespec ts;
+ clock_gettime(CLOCK_MONOTONIC, &ts);
+ return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int by_value(const void *a, const void *b) {
+ long la = *(const long *)a, lb = *(const long *)b;
+ return (la > lb) - (la < lb);
+}
+
+int main(int argc, char **argv) {
+ unsigned int seed = 1;
+ int speed = 3;
+ const char *path = 0;
+ for (int i = 1; i < argc; i++) {
+   if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+     seed = strtoul(argv[++i], 0, 10);
+   else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc)
+     speed = atoi(argv[++i]);
+   else
+     path = argv[i];
+ }
+ if (!path || speed <= 0) {
+   fprintf(stderr, "usage: %s [-s seed] [-v px_per_frame] level.bin\n", argv[0]);
+   return 2;
+ }
+
+ long load_start = now_ns();
+ int fd = open(path, O_RDONLY);
+ struct stat st;
+ if (fd < 0 || fstat(fd, &st) != 0) {
+   perror(path);
+   return 1;
+ }
+ void *data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+ close(fd);
+ if (data == MAP_FAILED || level_check(data, st.st_size) != 0) {
+   fprintf(stderr, "%s: not a valid level\n", path);
+   return 1;
+ }
+ const LevelHeader *level = data;
+ uint32_t peak_obstacles, peak_collectibles;
+ level_peak_active(level, &peak_obstacles, &peak_collectibles);
+ LevelStream stream;
+ if (level_stream_open(&stream, data, st.st_size) != 0) {
+   fprintf(stderr, "%s: up to %u obstacles and %u collectibles active at once, "
+           "the game holds %d and %d\n", path, peak_obstacles, peak_collectibles,
+           LEVEL_MAX_OBSTACLES, LEVEL_MAX_COLLECTIBLES);
+   return 1;
+ }
+ long load_ns = now_ns() - load_start;
+
+ long path_end = level->path_origin + (long)level->num_chunks * level->chunk_span;
+ long max_frames = path_end / speed + 1000000;
+ long *frame_ns = malloc(max_frames * sizeof(long));
+ PathWalker camera;
+ path_start(&camera, seed);
+ long frames = 0, streamed = 0, total_ns = 0, route_hits = 0;
+ int max_streamed = 0, max_obstacles = 0, max_collectibles = 0;
+
+ while (stream.next_chunk < level->num_chunks && frames < max_frames) {
+   for (int i = 0; i < speed; i++) {
+     path_step(&camera);
+     for (int o = 0; o < num_obstacles; o++) {
+       if (swept_hit(camera.x, camera.y, camera.x, camera.y, 1, obstacles[o].x,
+                     obstacles[o].y, obstacles[o].x + obstacles[o].width,
+                     obstacles[o].y + obstacles[o].height)) {
+         route_hits++;
+         break;
+       }
+     }
+   }
+   long start = now_ns();
+
+   // prune_obstacles() in main.c
+   int kept = 0;
+   for (int i = 0; i < num_obstacles; i++)
+     if (!is_behind(obstacles[i].x, obstacles[i].y, obstacles[i].width, camera.x,
+                    camera.y))
+       obstacles[kept++] = obstacles[i];
+   num_obstacles = kept;
+   // level_stream() and level_add() in main.c; the bench has no wrapping
+   // world origin, so positions are absolute
+   int count = 0;
+   const LevelRecord *rec;
+   while ((rec = level_stream_next(&stream, camera.x, camera.y, 0, 0))) {
+     Active *slot = 0;
+     if (rec->kind == LEVEL_OBSTACLE) {
+       if (num_obstacles < LEVEL_MAX_OBSTACLES)
+         slot = &obstacles[num_obstacles++];
+       else
+         dropped_obstacles++;
+     } else {
+       for (int c = 0; c < LEVEL_MAX_COLLECTIBLES && !slot; c++)
+         if (level_slot_free(collectibles[c].active, collectibles[c].x,
+                             collectibles[c].y, collectibles[c].width, camera.x,
+                             camera.y))
+           slot = &collectibles[c];
+       if (!slot) dropped_collectibles++;
+     }
+     if (!slot) continue;
+     slot->x = rec->x;
+     slot->y = rec->y;
+     slot->width = rec->width;
+     slot->height = rec->height;
+     slot->active = 1;
+     count++;
+   }
+   // the collectible loop in main.c clears the ones left behind
+   int active_collectibles = 0;
+   for (int c = 0; c < LEVEL_MAX_COLLECTIBLES; c++) {
+     if (collectibles[c].active &&
+         is_behind(collectibles[c].x, collectibles[c].y, collectibles[c].width,
+                   camera.x, camera.y))
+       collectibles[c].active = 0;
+     active_collectibles += collectibles[c].active;
+   }
+
+   long elapsed = now_ns() - start;
+   frame_ns[frames++] = elapsed;
+   total_ns += elapsed;
+   streamed += count;
+   if (count > max_streamed) max_streamed = count;
+   if (num_obstacles > max_obstacles) max_obstacles = num_obstacles;
+   if (active_collectibles > max_collectibles) max_collectibles = active_collectibles;
+ }
+
+ qsort(frame_ns, frames, sizeof(long), by_value);
+ printf("%s: %u records, %u chunks, %ld bytes, mapped+checked in %ld us\n",
+        path, level->num_records, level->num_chunks, (long)st.st_size,
+        load_ns / 1000);
+ printf("%ld frames at %d px/frame: %ld records streamed, "
+        "%ld obstacles and %ld collectibles dropped, %ld route steps hit\n",
+        frames, speed, streamed, dropped_obstacles, dropped_collectibles,
+        route_hits);
+ if (frames > 0)
+   printf("per frame: avg %ld ns, p99 %ld ns, max %ld ns; max %d records added\n",
+          total_ns / frames, frame_ns[frames * 99 / 100], frame_ns[frames - 1],
+          max_streamed);
+ printf("active at once: %d/%d obstacles, %d/%d collectibles "
+        "(any route: at most %u, %u)\n",
+        max_obstacles, LEVEL_MAX_OBSTACLES, max_collectibles,
+        LEVEL_MAX_COLLECTIBLES, peak_obstacles, peak_collectibles);
+ return dropped_obstacles || dropped_collectibles;
+}
@@ -0,0 +1,292 @@
+// Offline generator for Wave Dash levels (see level_format.h). Procedural
+// levels scatter entities around levelpath.h's route and keep every
+// obstacle clear of the whole route, so following it is always safe.
+//
+//   cc -O2 -o levelgen levelgen.c
+//   ./levelgen -n 100000 level.bin      # procedural level along a route
+//   ./levelgen -i layout.txt level.bin  # curated layout
+//   ./levelgen -i layout.txt -c level.c # C source for the board build
+//
+// A layout has one entity per line, in world coordinates with the player
+// starting at (160, 120):
+//   o <x> <y> [<width> <height>]   obstacle, 10x10 by default
+//   c <type> <x> <y>               collectible: 0 blue, 1 yellow, 2 orange
+// Blank lines and lines starting with '#' are ignored.
+//
+// The game holds at most LEVEL_MAX_OBSTACLES obstacles and
+// LEVEL_MAX_COLLECTIBLES collectibles at once, so a level that could ever
+// need more, on any route, is refused.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../collision.h"
+#include "../level_stream.h"
+#include "levelpath.h"
+
+#define DEFAULT_COUNT 100000
+#define DEFAULT_CHUNK_SPAN 64
+#define ENTITY_SPACING 8   // route pixels per generated entity
+#define ENTITY_SPREAD 100  // max distance from the route
+#define PATH_CLEARANCE 3   // free pixels between an obstacle and the player on the route
+
+LevelRecord *records;
+uint32_t num_records = 0;
+uint32_t capacity = 0;
+
+void add_record(int x, int y, int width, int height, int kind) {
+ if (num_records == capacity) {
+   capacity = capacity ? capacity * 2 : 1024;
+   records = realloc(records, capacity * sizeof(LevelRecord));
+   if (!records) {
+     perror("realloc");
+     exit(1);
+   }
+ }
+ LevelRecord *rec = &records[num_records++];
+ rec->x = x;
+ rec->y = y;
+ rec->width = width;
+ rec->height = height;
+ rec->kind = kind;
+ rec->reserved = 0;
+}
+
+// the route as the corners where each straight run starts, recorded by a
+// second walker as far ahead as the placement checks need
+typedef struct {
+ int x, y;
+ int step;
+} RouteCorner;
+RouteCorner *corners;
+uint32_t num_corners = 0;
+uint32_t corner_capacity = 0;
+PathWalker route_ahead;
+int route_steps = 0;  // route_ahead is at this step
+
+void route_extend(int step) {
+ while (route_steps < step) {
+   if (route_ahead.run_left <= 0) {  // path_step() turns here
+     if (num_corners == corner_capacity) {
+       corner_capacity = corner_capacity ? corner_capacity * 2 : 1024;
+       corners = realloc(corners, corner_capacity * sizeof(RouteCorner));
+       if (!corners) {
+         perror("realloc");
+         exit(1);
+       }
+     }
+     RouteCorner *corner = &corners[num_corners++];
+     corner->x = route_ahead.x;
+     corner->y = route_ahead.y;
+     corner->step = route_steps;
+   }
+   path_step(&route_ahead);
+   route_steps++;
+ }
+}
+
+// 1 when the player's 3x3 block stays more than PATH_CLEARANCE pixels from
+// the box everywhere on the route. each step adds 1 to the route's path
+// position x - y, so only the runs over the box's path positions can reach.
+int route_clear(int x, int y, int width, int height) {
+ int reach = 1 + PATH_CLEARANCE;
+ int start_path = route_ahead.x - route_ahead.y - route_steps;
+ int first = x - (y + height) - 2 * reach - start_path;
+ int last = x + width - y + 2 * reach - start_path;
+ if (first < 0) first = 0;
+ route_extend(last + 1);
+ uint32_t lo = 0, hi = num_corners;  // first run that ends at or after `first`
+ while (lo < hi) {
+   uint32_t mid = (lo + hi) / 2;
+   int end = mid + 1 < num_corners ? corners[mid + 1].step : route_steps;
+   if (end < first)
+     lo = mid + 1;
+   else
+     hi = mid;
+ }
+ for (uint32_t i = lo; i < num_corners && corners[i].step <= last; i++) {
+   int end_x = i + 1 < num_corners ? corners[i + 1].x : route_ahead.x;
+   int end_y = i + 1 < num_corners ? corners[i + 1].y : route_ahead.y;
+   if (swept_hit(corners[i].x, corners[i].y, end_x, end_y, reach, x, y,
+                 x + width, y + height))
+     return 0;
+ }
+ return 1;
+}
+
+void generate(int count, unsigned int seed) {
+ PathWalker route;
+ path_start(&route, seed);
+ path_start(&route_ahead, seed);
+ srand(seed);
+ while (count > 0) {
+   for (int i = 0; i < ENTITY_SPACING; i++) path_step(&route);
+   int x = route.x + rand() % (2 * ENTITY_SPREAD + 1) - ENTITY_SPREAD;
+   int y = route.y + rand() % (2 * ENTITY_SPREAD + 1) - ENTITY_SPREAD;
+   if (rand() % 12 == 0) {
+     add_record(x, y, 8, 8, LEVEL_COLLECTIBLE + rand() % 3);
+   } else {
+     if (!route_clear(x, y, 10, 10)) continue;
+     add_record(x, y, 10, 10, LEVEL_OBSTACLE);
+   }
+   count--;
+ }
+}
+
+int read_layout(const char *path) {
+ FILE *in = fopen(path, "r");
+ if (!in) {
+   perror(path);
+   return -1;
+ }
+ char line[256];
+ int line_no = 0;
+ while (fgets(line, sizeof(line), in)) {
+   line_no++;
+   char tag;
+   int a, b, c, d;
+   if (sscanf(line, " %c", &tag) != 1 || tag == '#') continue;
+   int n = sscanf(line, " %c %d %d %d %d", &tag, &a, &b, &c, &d);
+   if (tag == 'o' && n == 3) {
+     add_record(a, b, 10, 10, LEVEL_OBSTACLE);
+   } else if (tag == 'o' && n == 5 && c > 0 && c < 256 && d > 0 && d < 256) {
+     add_record(a, b, c, d, LEVEL_OBSTACLE);
+   } else if (tag == 'c' && n == 4 && a >= 0 && a <= 2) {
+     add_record(b, c, 8, 8, LEVEL_COLLECTIBLE + a);
+   } else {
+     fprintf(stderr, "%s:%d: bad entity\n", path, line_no);
+     fclose(in);
+     return -1;
+   }
+ }
+ fclose(in);
+ return 0;
+}
+
+int by_path(const void *a, const void *b) {
+ int pa = level_record_path(a);
+ int pb = level_record_path(b);
+ return (pa > pb) - (pa < pb);
+}
+
+int floor_div(int a, int b) {
+ return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// lays the level out in memory exactly as the game maps it
+uint8_t *build_level(int chunk_span, size_t *size) {
+ qsort(records, num_records, sizeof(LevelRecord), by_path);
+ LevelHeader header;
+ memset(&header, 0, sizeof(header));
+ header.magic = LEVEL_MAGIC;
+ header.version = LEVEL_VERSION;
+ header.record_size = sizeof(LevelRecord);
+ header.chunk_span = chunk_span;
+ header.num_records = num_records;
+ if (num_records > 0) {
+   int first = level_record_path(&records[0]);
+   int last = level_record_path(&records[num_records - 1]);
+   header.path_origin = floor_div(first, chunk_span) * chunk_span;
+   header.num_chunks = (last - header.path_origin) / chunk_span + 1;
+ }
+
+ *size = sizeof(header) + (header.num_chunks + 1) * sizeof(uint32_t) +
+         num_records * sizeof(LevelRecord);
+ uint8_t *data = malloc(*size);
+ if (!data) {
+   perror("malloc");
+   exit(1);
+ }
+ memcpy(data, &header, sizeof(header));
+ uint32_t *chunk_first = (uint32_t *)(data + sizeof(header));
+ uint32_t r = 0;
+ for (uint32_t c = 0; c < header.num_chunks; c++) {
+   int chunk_end = header.path_origin + (int)(c + 1) * chunk_span;
+   chunk_first[c] = r;
+   while (r < num_records && level_record_path(&records[r]) < chunk_end) r++;
+ }
+ chunk_first[header.num_chunks] = num_records;
+ memcpy(chunk_first + header.num_chunks + 1, records,
+        num_records * sizeof(LevelRecord));
+ return data;
+}
+
+int write_c_source(FILE *out, const uint8_t *data, size_t size) {
+ fprintf(out, "// generated by tools/levelgen\n");
+ fprintf(out, "__attribute__((aligned(4))) const unsigned char level_blob[] = {");
+ for (size_t i = 0; i < size; i++)
+   fprintf(out, "%s0x%02x,", i % 16 ? " " : "\n ", data[i]);
+ fprintf(out, "\n};\nconst unsigned int level_blob_size = %zu;\n", size);
+ return ferror(out) ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+ int count = DEFAULT_COUNT;
+ unsigned int seed = 1;
+ int chunk_span = DEFAULT_CHUNK_SPAN;
+ const char *layout = 0;
+ int c_source = 0;
+ const char *out_path = 0;
+ int bad_args = 0;
+ for (int i = 1; i < argc; i++) {
+   if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+     count = atoi(argv[++i]);
+   else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+     seed = strtoul(argv[++i], 0, 10);
+   else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+     chunk_span = atoi(argv[++i]);
+   else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+     layout = argv[++i];
+   else if (strcmp(argv[i], "-c") == 0)
+     c_source = 1;
+   else if (argv[i][0] != '-' && !out_path)
+     out_path = argv[i];
+   else
+     bad_args = 1;
+ }
+ if (bad_args || !out_path || count < 0 || chunk_span <= 0) {
+   fprintf(stderr,
+           "usage: %s [-n count] [-s seed] [-k chunk_span] [-i layout] [-c] out\n",
+           argv[0]);
+   return 2;
+ }
+
+ if (layout) {
+   if (read_layout(layout) != 0) return 1;
+ } else {
+   generate(count, seed);
+ }
+
+ size_t size;
+ uint8_t *data = build_level(chunk_span, &size);
+ if (level_check(data, size) != 0) {
+   fprintf(stderr, "internal error: generated level does not validate\n");
+   return 1;
+ }
+ uint32_t peak_obstacles, peak_collectibles;
+ level_peak_active((const LevelHeader *)data, &peak_obstacles, &peak_collectibles);
+ if (peak_obstacles > LEVEL_MAX_OBSTACLES || peak_collectibles > LEVEL_MAX_COLLECTIBLES) {
+   fprintf(stderr,
+           "too dense: up to %u obstacles and %u collectibles can be active at "
+           "once, the game holds %d and %d\n",
+           peak_obstacles, peak_collectibles, LEVEL_MAX_OBSTACLES,
+           LEVEL_MAX_COLLECTIBLES);
+   return 1;
+ }
+ FILE *out = fopen(out_path, c_source ? "w" : "wb");
+ if (!out) {
+   perror(out_path);
+   return 1;
+ }
+ int failed = c_source ? write_c_source(out, data, size)
+                       : fwrite(data, 1, size, out) != size;
+ if (fclose(out) != 0 || failed) {
+   perror(out_path);
+   return 1;
+ }
+ const LevelHeader *header = (const LevelHeader *)data;
+ fprintf(stderr, "%u records in %u chunks, %zu bytes\n", header->num_records,
+         header->num_chunks, size);
+ return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef LEVELPATH_H
+#define LEVELPATH_H
+
+// The staircase route levelgen lays a level along and levelbench flies the
+// camera along. Like the player, it alternates runs up and to the right.
+// It has its own generator so that both tools walk the same route for a
+// seed whatever else they draw from rand().
+typedef struct {
+ int x, y;
+ int direction;  // 0: up, 1: right
+ int run_left;
+ unsigned int seed;
+} PathWalker;
+
+static void path_start(PathWalker *w, unsigned int seed) {
+ w->x = 320 / 2;
+ w->y = 240 / 2;
+ w->direction = 1;
+ w->run_left = 0;
+ w->seed = seed;
+}
+
+static int path_rand(PathWalker *w) {
+ w->seed = w->seed * 1103515245u + 12345u;
+ return (w->seed >> 16) & 0x7FFF;
+}
+
+// advances one pixel, so the route is the same at any camera speed
+static void path_step(PathWalker *w) {
+ if (w->run_left <= 0) {
+   w->direction = !w->direction;
+   w->run_left = 40 + path_rand(w) % 160;
+ }
+ if (w->direction == 0)
+   w->y--;
+ else
+   w->x++;
+ w->run_left--;
+}
+
+#endif
@@ -0,0 +1,116 @@
+// Host test for the swept collision check in collision.h.
+//
+//   cc -O2 -o sweeptest sweeptest.c && ./sweeptest
+//
+// For every speed from 1 to MAX_SPEED px/frame, moving up and moving right,
+// a 10x10 obstacle (against the 3x3 player block) and an 8x8 collectible
+// (against the block's centre) are placed at every offset around the move.
+// The swept check must agree with walking the move one pixel at a time,
+// and must hit everything lying strictly between the previous and current
+// positions, which is exactly where the old end-position test missed.
+// Exits non-zero if any placement disagrees.
+#include <stdio.h>
+
+#include "../collision.h"
+
+#define MAX_SPEED 20
+#define OBSTACLE_SIZE 10
+#define COLLECTIBLE_SIZE 8
+
+typedef struct {
+ const char *name;
+ int size;
+ int reach;  // 1 for the 3x3 block, 0 for its centre
+} Target;
+
+// the old test: only the position the frame ends at
+int end_hit(int x, int y, int reach, int left, int top, int size) {
+ return swept_hit(x, y, x, y, reach, left, top, left + size, top + size);
+}
+
+// ground truth: every pixel position the move passes through
+int stepped_hit(int dx, int dy, int speed, int reach, int left, int top, int size) {
+ for (int i = 0; i <= speed; i++)
+   if (end_hit(i * dx, i * dy, reach, left, top, size)) return 1;
+ return 0;
+}
+
+int main() {
+ const Target targets[2] = {{"obstacle", OBSTACLE_SIZE, 1},
+                            {"collectible", COLLECTIBLE_SIZE, 0}};
+ const int dirs[2][2] = {{0, -1}, {1, 0}};  // up, right
+ const char *dir_names[2] = {"up", "right"};
+ int failures = 0;
+
+ for (int t = 0; t < 2; t++) {
+   const Target *target = &targets[t];
+   for (int d = 0; d < 2; d++) {
+     int dx = dirs[d][0], dy = dirs[d][1];
+     long missed = 0, caught = 0;
+     for (int speed = 1; speed <= MAX_SPEED; speed++) {
+       int end_x = speed * dx, end_y = speed * dy;
+       int margin = target->size + target->reach + 2;
+       int between = 0, missed_before = 0;
+       // a box of `size` fits strictly between the two ends from this speed
+       int can_tunnel = speed >= target->size + 2 * target->reach + 2;
+       for (int along = -margin; along <= speed + margin; along++) {
+         for (int across = -margin; across <= margin; across++) {
+           // (along, across) is the box's top-left corner relative to the
+           // move, turned onto the move's axis
+           int left = dx ? along : across;
+           int top = dx ? across : -along - target->size;
+           // already touching at the start: the previous frame handled it
+           if (end_hit(0, 0, target->reach, left, top, target->size)) continue;
+           int swept = swept_hit(0, 0, end_x, end_y, target->reach, left, top,
+                                 left + target->size, top + target->size);
+           int stepped = stepped_hit(dx, dy, speed, target->reach, left, top,
+                                     target->size);
+           int old = end_hit(end_x, end_y, target->reach, left, top, target->size);
+           if (swept != stepped) {
+             printf("FAIL %s %s speed %d at (%d, %d): swept %d, stepped %d\n",
+                    target->name, dir_names[d], speed, left, top, swept, stepped);
+             failures++;
+           }
+           if (stepped && !old) {
+             missed_before++;
+             missed++;
+             if (swept) caught++;
+           }
+           int strictly_between = dx ? left - target->reach > 0 &&
+                                           left + target->size + target->reach < end_x
+                                     : top + target->size + target->reach < 0 &&
+                                           top - target->reach > end_y;
+           if (strictly_between && stepped) {
+             between++;
+             if (!swept || old) {
+               printf("FAIL %s %s speed %d at (%d, %d): between the ends, "
+                      "swept %d, end-position %d\n",
+                      target->name, dir_names[d], speed, left, top, swept, old);
+               failures++;
+             }
+           }
+         }
+       }
+       if (can_tunnel && (between == 0 || missed_before == 0)) {
+         printf("FAIL %s %s speed %d: no placement between the ends was tested\n",
+                target->name, dir_names[d], speed);
+         failures++;
+       }
+       if (!can_tunnel && between != 0) {
+         printf("FAIL %s %s speed %d: %d placements fit between the ends\n",
+                target->name, dir_names[d], speed, between);
+         failures++;
+       }
+     }
+     printf("%-11s %-5s speeds 1-%d: end-position test missed %ld hits, "
+            "swept test caught %ld\n",
+            target->name, dir_names[d], MAX_SPEED, missed, caught);
+   }
+ }
+ if (failures) {
+   printf("%d failures\n", failures);
+   return 1;
+ }
+ printf("ok\n");
+ return 0;
+}